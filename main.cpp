@@ -20,11 +20,20 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <new>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -35,6 +44,12 @@ const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 const unsigned int GENERATE_FISH = 20;
 const float CATCH_RADIUS = 1.2f;
+const size_t FRAME_ARENA_SIZE = 256 * 1024;
+const unsigned int ALLOC_WARMUP_FRAMES = 10;
+const size_t MAX_DRAW_PACKETS = 1024;
+const float FAR_PLANE = 100.0f;
+const string SHADER_CACHE_DIR = "shader_cache";
+const unsigned int SHADER_CACHE_VERSION = 1;
 const string MODEL_SHARK_PATH = FileSystem::getPath("src/game_3d/Hungry_Fish_3D/great_white_shark.glb");
 const string MODEL_FISH_PATH = FileSystem::getPath("src/game_3d/Hungry_Fish_3D/low_poly_fish.glb");
 
@@ -45,11 +60,559 @@ struct Fish {
     float speed;
 };
 
+// ==============================================
+// Allocation Tracking
+// ==============================================
+// Counts every call to the global operator new so the main loop and the
+// load phases can report how much they hit the heap. The replacement is
+// process-wide: C++ shared libraries (Assimp, driver shader compilers and
+// driver worker threads) are counted too. Plain malloc calls from C
+// libraries such as GLFW and stb_image are not.
+namespace AllocStats {
+    std::atomic<size_t> count{ 0 };
+    std::atomic<size_t> bytes{ 0 };
+}
+
+void* operator new(std::size_t size) {
+    AllocStats::count.fetch_add(1, std::memory_order_relaxed);
+    AllocStats::bytes.fetch_add(size, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Snapshot of the counters; count()/bytes() return the delta since reset()
+struct AllocCounter {
+    size_t startCount = 0;
+    size_t startBytes = 0;
+
+    AllocCounter() { reset(); }
+
+    void reset() {
+        startCount = AllocStats::count.load(std::memory_order_relaxed);
+        startBytes = AllocStats::bytes.load(std::memory_order_relaxed);
+    }
+
+    size_t count() const { return AllocStats::count.load(std::memory_order_relaxed) - startCount; }
+    size_t bytes() const { return AllocStats::bytes.load(std::memory_order_relaxed) - startBytes; }
+
+    // Print the delta for a load phase and start measuring the next one
+    void reportPhase(const char* phase) {
+        std::cout << "[alloc] load " << phase << ": " << count() << " allocations, "
+                  << bytes() / 1024 << " KB" << std::endl;
+        reset();
+    }
+};
+
+// ==============================================
+// Frame Arena
+// ==============================================
+// Bump allocator for data that only lives for one frame (model matrices,
+// draw lists). The buffer is allocated once; reset() at frame end rewinds it.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity)
+        : buffer(new unsigned char[capacity]), capacity(capacity) {}
+    ~FrameArena() { delete[] buffer; }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Returns nullptr when the arena is exhausted
+    template <typename T>
+    T* alloc(size_t n) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destructed");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned type");
+
+        size_t start = (offset + alignof(T) - 1) & ~(alignof(T) - 1);
+        if (start + sizeof(T) * n > capacity) {
+            std::cout << "ERROR::FRAME_ARENA:: out of memory (" << capacity << " bytes)" << std::endl;
+            return nullptr;
+        }
+        offset = start + sizeof(T) * n;
+        peak = std::max(peak, offset);
+        return reinterpret_cast<T*>(buffer + start);
+    }
+
+    void reset() { offset = 0; }
+    size_t peakUsage() const { return peak; }
+
+private:
+    unsigned char* buffer;
+    size_t capacity;
+    size_t offset = 0;
+    size_t peak = 0;
+};
+
+// ==============================================
+// Uniforms
+// ==============================================
+// Locations resolved once at init so the frame loop never builds
+// std::string uniform names or calls glGetUniformLocation.
+struct MatrixUniforms {
+    int model = -1;
+    int view = -1;
+    int projection = -1;
+
+    void init(unsigned int program) {
+        model = glGetUniformLocation(program, "model");
+        view = glGetUniformLocation(program, "view");
+        projection = glGetUniformLocation(program, "projection");
+    }
+};
+
+inline void setMat4(int location, const glm::mat4& mat) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+// ==============================================
+// Shader Manager
+// ==============================================
+// GL_ARB_get_program_binary is core only since 4.1, so on our 3.3 context
+// the entry points are fetched by hand when the driver exposes them.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint, GLenum, const void*, GLsizei);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint, GLenum, GLint);
+
+// Programs are de-duplicated by a hash of their sources, and linked
+// binaries are persisted to SHADER_CACHE_DIR. Cache files embed the
+// vendor/renderer/version string, so a driver update invalidates them.
+class ShaderManager {
+public:
+    size_t cacheHits = 0;
+    size_t cacheMisses = 0;
+    size_t deduplicated = 0;
+
+    void init() {
+        const GLubyte* vendor = glGetString(GL_VENDOR);
+        const GLubyte* renderer = glGetString(GL_RENDERER);
+        const GLubyte* version = glGetString(GL_VERSION);
+        if (!vendor || !renderer || !version) {
+            // Without a driver key a cached binary cannot be validated
+            std::cout << "ERROR::SHADER_CACHE:: driver strings unavailable, binary cache disabled" << std::endl;
+            binarySupported = false;
+            return;
+        }
+        driverKey = std::string(reinterpret_cast<const char*>(vendor)) + "|" +
+                    reinterpret_cast<const char*>(renderer) + "|" +
+                    reinterpret_cast<const char*>(version) + "|" +
+                    std::to_string(SHADER_CACHE_VERSION);
+
+        if (glfwExtensionSupported("GL_ARB_get_program_binary")) {
+            getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(glfwGetProcAddress("glGetProgramBinary"));
+            programBinary = reinterpret_cast<ProgramBinaryProc>(glfwGetProcAddress("glProgramBinary"));
+            programParameteri = reinterpret_cast<ProgramParameteriProc>(glfwGetProcAddress("glProgramParameteri"));
+        }
+        GLint numFormats = 0;
+        if (getProgramBinary && programBinary && programParameteri)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        binarySupported = numFormats > 0;
+
+        std::error_code ec;
+        if (binarySupported)
+            std::filesystem::create_directories(SHADER_CACHE_DIR, ec);
+        if (ec) {
+            std::cout << "ERROR::SHADER_CACHE:: cannot create " << SHADER_CACHE_DIR << ": " << ec.message() << std::endl;
+            binarySupported = false;
+        }
+    }
+
+    // Returns the program ID, or 0 if it failed to compile or link
+    unsigned int load(const char* vertexPath, const char* fragmentPath) {
+        std::string vertexCode = readFile(vertexPath);
+        std::string fragmentCode = readFile(fragmentPath);
+        uint64_t sourceHash = fnv1a(vertexCode + '\0' + fragmentCode);
+
+        auto it = programs.find(sourceHash);
+        if (it != programs.end()) {
+            ++deduplicated;
+            return it->second;
+        }
+
+        std::string cachePath = cacheFilePath(sourceHash);
+        unsigned int program = binarySupported ? loadBinary(cachePath) : 0;
+        if (program) {
+            ++cacheHits;
+        } else {
+            ++cacheMisses;
+            program = compile(vertexCode, fragmentCode);
+            if (program && binarySupported)
+                saveBinary(cachePath, program);
+        }
+
+        if (program)
+            programs[sourceHash] = program;
+        return program;
+    }
+
+private:
+    std::string driverKey;
+    bool binarySupported = false;
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinary = nullptr;
+    ProgramParameteriProc programParameteri = nullptr;
+    std::unordered_map<uint64_t, unsigned int> programs;
+
+    static uint64_t fnv1a(const std::string& data) {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static std::string readFile(const char* path) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return std::string();
+        }
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    }
+
+    std::string cacheFilePath(uint64_t sourceHash) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin",
+                      static_cast<unsigned long long>(fnv1a(driverKey) ^ sourceHash));
+        return SHADER_CACHE_DIR + "/" + name;
+    }
+
+    static bool checkStatus(unsigned int object, bool isProgram, const char* type) {
+        GLint success = 0;
+        char infoLog[1024];
+        if (isProgram) {
+            glGetProgramiv(object, GL_LINK_STATUS, &success);
+            if (!success) {
+                glGetProgramInfoLog(object, sizeof(infoLog), nullptr, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << std::endl;
+            }
+        } else {
+            glGetShaderiv(object, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                glGetShaderInfoLog(object, sizeof(infoLog), nullptr, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << std::endl;
+            }
+        }
+        return success != 0;
+    }
+
+    unsigned int compile(const std::string& vertexCode, const std::string& fragmentCode) const {
+        const char* vShaderCode = vertexCode.c_str();
+        const char* fShaderCode = fragmentCode.c_str();
+
+        unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, nullptr);
+        glCompileShader(vertex);
+        bool ok = checkStatus(vertex, false, "VERTEX");
+
+        unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, nullptr);
+        glCompileShader(fragment);
+        ok = checkStatus(fragment, false, "FRAGMENT") && ok;
+
+        unsigned int program = glCreateProgram();
+        if (binarySupported)
+            programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+        ok = ok && checkStatus(program, true, "PROGRAM");
+
+        glDetachShader(program, vertex);
+        glDetachShader(program, fragment);
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if (!ok) {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    // File layout: key length, driver key, binary format, binary length, binary
+    unsigned int loadBinary(const std::string& path) const {
+        std::error_code ec;
+        uintmax_t fileSize = std::filesystem::file_size(path, ec);
+        if (ec) return 0;
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return 0;
+
+        uint32_t keyLength = 0;
+        file.read(reinterpret_cast<char*>(&keyLength), sizeof(keyLength));
+        if (!file || keyLength != driverKey.size()) return 0;
+        std::string key(keyLength, '\0');
+        file.read(&key[0], keyLength);
+        if (!file || key != driverKey) return 0;
+
+        uint32_t format = 0, length = 0;
+        file.read(reinterpret_cast<char*>(&format), sizeof(format));
+        file.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!file || length == 0) return 0;
+        // A corrupt length must not drive the allocation; it has to match the payload exactly
+        std::streamoff offset = file.tellg();
+        if (offset < 0 || static_cast<uintmax_t>(offset) > fileSize ||
+            length != fileSize - static_cast<uintmax_t>(offset)) return 0;
+        std::vector<char> binary(length);
+        file.read(binary.data(), length);
+        if (!file) return 0;
+
+        unsigned int program = glCreateProgram();
+        programBinary(program, format, binary.data(), static_cast<GLsizei>(length));
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // Driver rejected the binary; the caller recompiles and overwrites it
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    void saveBinary(const std::string& path, unsigned int program) const {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        getProgramBinary(program, length, nullptr, &format, binary.data());
+
+        // Write to a temp file and rename it into place, so a failed write
+        // never leaves a truncated entry that is reread on every launch
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            uint32_t keyLength = static_cast<uint32_t>(driverKey.size());
+            uint32_t format32 = format;
+            uint32_t length32 = static_cast<uint32_t>(length);
+            file.write(reinterpret_cast<const char*>(&keyLength), sizeof(keyLength));
+            file.write(driverKey.data(), keyLength);
+            file.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+            file.write(reinterpret_cast<const char*>(&length32), sizeof(length32));
+            file.write(binary.data(), length);
+            file.close();
+            if (!file) {
+                std::cout << "ERROR::SHADER_CACHE:: cannot write " << tempPath << std::endl;
+                std::error_code ec;
+                std::filesystem::remove(tempPath, ec);
+                return;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) {
+            std::cout << "ERROR::SHADER_CACHE:: cannot replace " << path << ": " << ec.message() << std::endl;
+            std::filesystem::remove(tempPath, ec);
+        }
+    }
+};
+
+// ==============================================
+// Render Queue
+// ==============================================
+// Passes execute in enum order: the skybox goes last so early-Z rejects
+// every pixel already covered by the shark and the fish.
+enum RenderPass : unsigned int {
+    PASS_OPAQUE = 0,
+    PASS_SKYBOX = 1
+};
+
+// One draw call plus the state it needs. Matrices are pointers into data
+// that lives until execute() (render() locals or the frame arena).
+struct DrawPacket {
+    uint64_t key = 0;
+    RenderPass pass = PASS_OPAQUE;
+    float depth = 0.0f;
+
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int texture = 0;
+    GLenum textureTarget = GL_TEXTURE_2D;
+    GLenum depthFunc = GL_LESS;
+    unsigned int count = 0;     // index count, or vertex count when not indexed
+    bool indexed = true;
+
+    const MatrixUniforms* uniforms = nullptr;
+    const glm::mat4* model = nullptr;
+    const glm::mat4* view = nullptr;
+    const glm::mat4* projection = nullptr;
+};
+
+struct RenderStats {
+    size_t draws = 0;
+    size_t programs = 0;
+    size_t textures = 0;
+    size_t vaos = 0;
+    size_t depthFuncs = 0;
+    size_t matrixUploads = 0;
+    size_t dropped = 0;         // packets rejected because the queue was full
+
+    size_t stateChanges() const { return programs + textures + vaos + depthFuncs; }
+
+    void add(const RenderStats& other) {
+        draws += other.draws;
+        programs += other.programs;
+        textures += other.textures;
+        vaos += other.vaos;
+        depthFuncs += other.depthFuncs;
+        matrixUploads += other.matrixUploads;
+        dropped += other.dropped;
+    }
+};
+
+class RenderQueue {
+public:
+    RenderStats preQueue;   // what the same packets cost in the draw order the queue replaced
+    RenderStats executed;   // state changes actually issued after sorting
+
+    // Packet storage comes from the frame arena, so begin() once per frame
+    void begin(FrameArena& arena) {
+        packets = arena.alloc<DrawPacket>(MAX_DRAW_PACKETS);
+        count = 0;
+        preQueue = RenderStats();
+        executed = RenderStats();
+    }
+
+    void submit(DrawPacket packet) {
+        // No storage: begin() found the frame arena exhausted (already logged there)
+        if (!packets) {
+            ++executed.dropped;
+            return;
+        }
+        if (count == MAX_DRAW_PACKETS) {
+            if (executed.dropped++ == 0)
+                std::cout << "ERROR::RENDER_QUEUE:: full (" << MAX_DRAW_PACKETS << " packets), dropping draws" << std::endl;
+            return;
+        }
+        packet.key = makeKey(packet);
+        packets[count++] = packet;
+    }
+
+    void execute() {
+        if (!packets) return;
+        countPreQueue();
+        std::sort(packets, packets + count,
+                  [](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+
+        unsigned int program = 0, vao = 0, texture = 0;
+        GLenum textureTarget = 0, depthFunc = GL_LESS;
+        const glm::mat4* view = nullptr;
+        const glm::mat4* projection = nullptr;
+
+        glActiveTexture(GL_TEXTURE0);
+        for (size_t i = 0; i < count; ++i) {
+            const DrawPacket& p = packets[i];
+
+            if (p.depthFunc != depthFunc) {
+                glDepthFunc(p.depthFunc);
+                depthFunc = p.depthFunc;
+                ++executed.depthFuncs;
+            }
+            if (p.program != program) {
+                glUseProgram(p.program);
+                program = p.program;
+                view = projection = nullptr;
+                ++executed.programs;
+            }
+            if (p.view != view) {
+                setMat4(p.uniforms->view, *p.view);
+                view = p.view;
+                ++executed.matrixUploads;
+            }
+            if (p.projection != projection) {
+                setMat4(p.uniforms->projection, *p.projection);
+                projection = p.projection;
+                ++executed.matrixUploads;
+            }
+            if (p.model) {
+                setMat4(p.uniforms->model, *p.model);
+                ++executed.matrixUploads;
+            }
+
+            if (p.texture != texture || p.textureTarget != textureTarget) {
+                glBindTexture(p.textureTarget, p.texture);
+                texture = p.texture;
+                textureTarget = p.textureTarget;
+                ++executed.textures;
+            }
+            if (p.vao != vao) {
+                glBindVertexArray(p.vao);
+                vao = p.vao;
+                ++executed.vaos;
+            }
+
+            if (p.indexed)
+                glDrawElements(GL_TRIANGLES, p.count, GL_UNSIGNED_INT, 0);
+            else
+                glDrawArrays(GL_TRIANGLES, 0, p.count);
+            ++executed.draws;
+        }
+
+        glBindVertexArray(0);
+        if (depthFunc != GL_LESS) {
+            glDepthFunc(GL_LESS);
+            ++executed.depthFuncs;
+        }
+    }
+
+private:
+    DrawPacket* packets = nullptr;
+    size_t count = 0;
+
+    // pass | program | texture | VAO | depth (front to back)
+    static uint64_t makeKey(const DrawPacket& p) {
+        float depth01 = glm::clamp(p.depth / FAR_PLANE, 0.0f, 1.0f);
+        uint64_t depthBits = static_cast<uint64_t>(depth01 * 65535.0f);
+        return (static_cast<uint64_t>(p.pass & 0xF) << 60) |
+               (static_cast<uint64_t>(p.program & 0xFFF) << 48) |
+               (static_cast<uint64_t>(p.texture & 0xFFFF) << 32) |
+               (static_cast<uint64_t>(p.vao & 0xFFFF) << 16) |
+               depthBits;
+    }
+
+    // The loop this queue replaced drew the skybox first, wrapped in
+    // GL_LEQUAL/GL_LESS, and every draw rebound its program, texture and
+    // VAO and re-uploaded its matrices. Replay that sequence without
+    // filtering. Redundant use() calls are not counted, so this is a lower bound.
+    void countPreQueue() {
+        const RenderPass order[] = { PASS_SKYBOX, PASS_OPAQUE };
+        for (RenderPass pass : order) {
+            for (size_t i = 0; i < count; ++i) {
+                const DrawPacket& p = packets[i];
+                if (p.pass != pass) continue;
+                if (p.depthFunc != GL_LESS) preQueue.depthFuncs += 2;
+                ++preQueue.programs;
+                ++preQueue.textures;
+                ++preQueue.vaos;
+                preQueue.matrixUploads += p.model ? 3 : 2;
+                ++preQueue.draws;
+            }
+        }
+    }
+};
+
 // ==============================================
 // Utility Functions
 // ==============================================
 unsigned int loadTexture(const char *path);
-unsigned int loadCubemap(vector<std::string> faces);
+unsigned int loadCubemap(const vector<std::string>& faces);
 
 // ==============================================
 // Model
@@ -63,16 +626,24 @@ public:
         return true;
     };
 
-    void draw(Shader& shader){
-        for (unsigned int i = 0; i < meshes.size(); i++)
+    // One packet per mesh; the caller fills in program, uniforms and matrices.
+    // model.fs only samples texture_diffuse1 on unit 0, so the first texture
+    // of each mesh is the only one that needs binding.
+    void submit(RenderQueue& queue, DrawPacket packet) const {
+        for (const Mesh& mesh : meshes)
         {
-            shader.use();
-            meshes[i].Draw(shader);
+            packet.vao = mesh.VAO;
+            packet.texture = mesh.textures.empty() ? 0 : mesh.textures[0].id;
+            packet.count = static_cast<unsigned int>(mesh.indices.size());
+            queue.submit(packet);
         }
     }
 
 
 private:
+    // Textures already uploaded for this model, shared across its meshes
+    std::vector<Texture> texturesLoaded;
+
     void loadModel(const std::string& path) {
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(
@@ -85,6 +656,7 @@ private:
         }
 
         std::string directory = path.substr(0, path.find_last_of('/'));
+        meshes.reserve(meshes.size() + scene->mNumMeshes);
         processNode(scene->mRootNode, scene, directory, path);
     }
 
@@ -107,6 +679,11 @@ private:
 
         //std::cout << "Total embedded textures in scene: " << scene->mNumTextures << std::endl;
 
+        unsigned int totalCount = 0;
+        for (int typeInt = aiTextureType_NONE; typeInt <= aiTextureType_UNKNOWN; ++typeInt)
+            totalCount += mat->GetTextureCount(static_cast<aiTextureType>(typeInt));
+        textures.reserve(totalCount);
+
         for (int typeInt = aiTextureType_NONE; typeInt <= aiTextureType_UNKNOWN; ++typeInt)
         {
             aiTextureType type = static_cast<aiTextureType>(typeInt);
@@ -221,6 +798,8 @@ private:
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
         std::vector<Texture> textures;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
 
         // --- vertices ---
         for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
@@ -259,7 +838,7 @@ private:
 
         // --- indices ---
         for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-            aiFace face = mesh->mFaces[i];
+            const aiFace& face = mesh->mFaces[i];
             for (unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
@@ -267,11 +846,11 @@ private:
         // --- textures ---
         if (mesh->mMaterialIndex >= 0) {
             aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-            std::vector<Texture> loadedTextures =
-                loadMaterialTextures(scene, material, directory, textures, path);
-            textures.insert(textures.end(), loadedTextures.begin(), loadedTextures.end());
+            textures = loadMaterialTextures(scene, material, directory, texturesLoaded, path);
         }
-        return Mesh(vertices, indices, textures);
+        // Moving saves the by-value parameter copy, but learnopengl's Mesh
+        // constructor still copy-assigns each buffer into its members once
+        return Mesh(std::move(vertices), std::move(indices), std::move(textures));
     }
 
 };
@@ -282,8 +861,9 @@ private:
 class Skybox {
 public:
     unsigned int VAO, VBO, textureID;
+    MatrixUniforms uniforms;
 
-    bool init(const std::vector<std::string>& faces) {
+    bool init(const std::vector<std::string>& faces, unsigned int program) {
         float skyboxVertices[] = {
             -1.0f,  1.0f, -1.0f,
             -1.0f, -1.0f, -1.0f,
@@ -337,23 +917,26 @@ public:
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
+        uniforms.init(program);
         textureID = loadCubemap(faces);
         return textureID != 0;
     }
 
-    void draw(const Shader& shader, Camera& camera, const glm::mat4& projection) const {
-        glDepthFunc(GL_LEQUAL);
-        shader.use();
-        glm::mat4 view = glm::mat4(glm::mat3(camera.GetViewMatrix()));
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
-
-        glBindVertexArray(VAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
+    // view must already have its translation stripped
+    void submit(RenderQueue& queue, unsigned int program, const glm::mat4& view, const glm::mat4& projection) const {
+        DrawPacket packet;
+        packet.pass = PASS_SKYBOX;
+        packet.program = program;
+        packet.vao = VAO;
+        packet.texture = textureID;
+        packet.textureTarget = GL_TEXTURE_CUBE_MAP;
+        packet.depthFunc = GL_LEQUAL;
+        packet.count = 36;
+        packet.indexed = false;
+        packet.uniforms = &uniforms;
+        packet.view = &view;
+        packet.projection = &projection;
+        queue.submit(packet);
     }
 };
 
@@ -377,13 +960,27 @@ public:
     Skybox skybox;
     Model sharkModel;
     Model fishModel;
-    Shader* skyboxShader = nullptr;
-    Shader* sharkShader = nullptr;
-    Shader* fishShader = nullptr;
+    ShaderManager shaders;
+    unsigned int skyboxProgram = 0;
+    unsigned int sharkProgram = 0;
+    unsigned int fishProgram = 0;
+    MatrixUniforms modelUniforms;   // shark and fish share the model.vs/model.fs program
+
+    FrameArena frameArena{ FRAME_ARENA_SIZE };
+    RenderQueue renderQueue;
+    RenderStats preQueueTotals;
+    RenderStats executedTotals;
+    size_t renderedFrames = 0;
+    unsigned int warmupFrames = 0;
+    size_t warmupAllocs = 0;
+    size_t steadyFrames = 0;
+    size_t allocatingFrames = 0;
+    size_t peakFrameAllocs = 0;
 
     bool init() {
         // Init GLFW
         glfwInit();
+        double initStart = glfwGetTime();
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -412,9 +1009,17 @@ public:
 
         glEnable(GL_DEPTH_TEST);
 
-        skyboxShader = new Shader("skybox.vs", "skybox.fs");
-        sharkShader = new Shader("model.vs", "model.fs");
-        fishShader = new Shader("model.vs", "model.fs");
+        AllocCounter phase;
+        double shaderStart = glfwGetTime();
+        shaders.init();
+        skyboxProgram = shaders.load("skybox.vs", "skybox.fs");
+        sharkProgram = shaders.load("model.vs", "model.fs");
+        fishProgram = shaders.load("model.vs", "model.fs");
+        if (!skyboxProgram || !sharkProgram || !fishProgram)
+            return false;
+        modelUniforms.init(sharkProgram);
+        double shaderTime = glfwGetTime() - shaderStart;
+        phase.reportPhase("shaders");
 
         std::vector<std::string> faces = {
             FileSystem::getPath("resources/textures/skybox/right.jpg"),
@@ -424,19 +1029,46 @@ public:
             FileSystem::getPath("resources/textures/skybox/front.jpg"),
             FileSystem::getPath("resources/textures/skybox/back.jpg")
         };
-        skybox.init(faces);
+        skybox.init(faces, skyboxProgram);
+        phase.reportPhase("skybox");
         sharkModel.init(MODEL_SHARK_PATH);
+        phase.reportPhase("shark model");
         fishModel.init(MODEL_FISH_PATH);
+        phase.reportPhase("fish model");
 
         initFishes();
+        phase.reportPhase("fishes");
 
         camera.MovementSpeed = 5.0f;
 
+        warmUpPipelines();
+        reportStartup(glfwGetTime() - initStart, shaderTime);
+
         return true;
     }
 
+    // Drivers finish compiling a program on its first draw. Run one frame
+    // with color and depth writes off so that happens before the game starts.
+    void warmUpPipelines() {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        render();
+        glFinish();
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+        frameArena.reset();
+    }
+
+    void reportStartup(double initTime, double shaderTime) const {
+        std::cout << "[startup] " << (shaders.cacheMisses == 0 ? "warm" : "cold") << " shader cache: init "
+                  << initTime * 1000.0 << " ms, shaders " << shaderTime * 1000.0 << " ms ("
+                  << shaders.cacheHits << " from cache, " << shaders.cacheMisses << " compiled, "
+                  << shaders.deduplicated << " deduplicated)" << std::endl;
+    }
+
     void initFishes() {
         srand(static_cast<unsigned int>(time(0)));
+        fishes.reserve(GENERATE_FISH);
         for (int i = 0; i < GENERATE_FISH; ++i) {
             glm::vec3 spawn(
                 ((rand() % 10000) / 10000.0f - 0.5f) * 15.0f,
@@ -487,9 +1119,9 @@ public:
 
     void renderHUD() {
         std::cout << "\rFish left: " << fishCount << " " << std::flush;
-        std::stringstream ss;
-        ss << "Hungry_Fish_3D - Fish left: " << fishCount;
-        glfwSetWindowTitle(window, ss.str().c_str());
+        char title[64];
+        std::snprintf(title, sizeof(title), "Hungry_Fish_3D - Fish left: %d", fishCount);
+        glfwSetWindowTitle(window, title);
 
         if (fishCount == 0) {
             glfwSetWindowTitle(window, "Hungry_Fish_3D - You're full. Press Esc to exit.");
@@ -499,9 +1131,12 @@ public:
     }
 
     void renderFishes(const glm::mat4& view, const glm::mat4& projection) {
-        fishShader->use();
+        glm::mat4* fishMatrices = frameArena.alloc<glm::mat4>(fishes.size());
+        if (!fishMatrices) return;
 
-        for (const auto& f : fishes) {
+        float now = static_cast<float>(glfwGetTime());
+        for (size_t i = 0; i < fishes.size(); ++i) {
+            const Fish& f = fishes[i];
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::translate(model, f.position);
 
@@ -517,23 +1152,27 @@ public:
             model = glm::rotate(model, -pitch, glm::vec3(0.5f, 0.0f, 0.0f));
 
             // Add a body sway (left-right oscillation)
-            float sway = sin(glfwGetTime() * 6.0f + f.position.x * 0.5f) * glm::radians(10.0f);
+            float sway = sin(now * 6.0f + f.position.x * 0.5f) * glm::radians(10.0f);
             model = glm::rotate(model, sway, glm::vec3(0.0f, 1.0f, 0.0f));
 
             // Slight roll for more natural swimming (Z-axis wobble)
-            float roll = sin(glfwGetTime() * 3.0f + f.position.z) * glm::radians(3.0f);
+            float roll = sin(now * 3.0f + f.position.z) * glm::radians(3.0f);
             model = glm::rotate(model, roll, glm::vec3(0.0f, 0.0f, 1.0f));
 
             // Scale the fish model
             model = glm::scale(model, glm::vec3(0.7f));
+            fishMatrices[i] = model;
+        }
 
-            // Set shader uniforms and draw
-            fishShader->use();
-            fishShader->setMat4("model", model);
-            fishShader->setMat4("view", view);
-            fishShader->setMat4("projection", projection);
-
-            fishModel.draw(*fishShader);
+        DrawPacket packet;
+        packet.program = fishProgram;
+        packet.uniforms = &modelUniforms;
+        packet.view = &view;
+        packet.projection = &projection;
+        for (size_t i = 0; i < fishes.size(); ++i) {
+            packet.model = &fishMatrices[i];
+            packet.depth = glm::length(fishes[i].position - camera.Position);
+            fishModel.submit(renderQueue, packet);
         }
     }
 
@@ -543,29 +1182,75 @@ public:
             deltaTime = currentFrame - lastFrame;
             lastFrame = currentFrame;
 
+            AllocCounter frameAllocs;
             processInput();
             updateFishes(deltaTime);
             render();
+            preQueueTotals.add(renderQueue.preQueue);
+            executedTotals.add(renderQueue.executed);
+            ++renderedFrames;
             glfwSwapBuffers(window);
             glfwPollEvents();
+            frameArena.reset();
+            trackFrameAllocs(frameAllocs.count());
         }
         glfwTerminate();
+        reportFrameAllocs();
+        reportRenderStats();
     }
 
 private:
+    // The first frames are tallied on their own so a one-off allocation
+    // there is still reported without masking the steady-state figures
+    void trackFrameAllocs(size_t allocs) {
+        if (warmupFrames < ALLOC_WARMUP_FRAMES) {
+            ++warmupFrames;
+            warmupAllocs += allocs;
+            return;
+        }
+        ++steadyFrames;
+        if (allocs > 0) ++allocatingFrames;
+        peakFrameAllocs = std::max(peakFrameAllocs, allocs);
+    }
+
+    void reportFrameAllocs() const {
+        std::cout << "\n[alloc] first " << warmupFrames << " frames: " << warmupAllocs
+                  << " allocations; " << steadyFrames << " steady-state frames, "
+                  << allocatingFrames << " with heap allocations, peak "
+                  << peakFrameAllocs << " allocations/frame, frame arena peak "
+                  << frameArena.peakUsage() << " bytes" << std::endl;
+        std::cout << "[alloc] counts are process-wide; GL driver threads using operator new add to them" << std::endl;
+    }
+
+    void reportRenderStats() const {
+        if (renderedFrames == 0) return;
+        auto perFrame = [this](size_t total) { return static_cast<double>(total) / renderedFrames; };
+        std::cout << "[render] " << perFrame(executedTotals.draws) << " draws/frame, state changes/frame: "
+                  << perFrame(preQueueTotals.stateChanges()) << " in pre-queue order (skybox first, unfiltered), "
+                  << perFrame(executedTotals.stateChanges()) << " sorted (programs "
+                  << perFrame(executedTotals.programs) << ", textures "
+                  << perFrame(executedTotals.textures) << ", VAOs "
+                  << perFrame(executedTotals.vaos) << ", depth func "
+                  << perFrame(executedTotals.depthFuncs) << "); matrix uploads/frame: "
+                  << perFrame(preQueueTotals.matrixUploads) << " -> "
+                  << perFrame(executedTotals.matrixUploads) << std::endl;
+        if (executedTotals.dropped > 0)
+            std::cout << "[render] " << executedTotals.dropped
+                      << " packets dropped (queue full or frame arena exhausted)" << std::endl;
+    }
+
     void render() {
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
-            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, FAR_PLANE);
 
         glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 skyboxView = glm::mat4(glm::mat3(view));
 
-        skyboxShader->use();
-        skybox.draw(*skyboxShader, camera, projection);
+        renderQueue.begin(frameArena);
 
-        sharkShader->use();
         glm::mat4 modelShark = glm::mat4(1.0f);
         glm::vec3 offset = glm::vec3(0.0f, -0.35f, 0.0f);
         modelShark = glm::translate(modelShark, camera.Position + offset);
@@ -578,12 +1263,19 @@ private:
 
         modelShark = glm::scale(modelShark, glm::vec3(0.3f));
 
-        sharkShader->setMat4("model", modelShark);
-        sharkShader->setMat4("view", view);
-        sharkShader->setMat4("projection", projection);
-        sharkModel.draw(*sharkShader);
+        DrawPacket sharkPacket;
+        sharkPacket.program = sharkProgram;
+        sharkPacket.uniforms = &modelUniforms;
+        sharkPacket.model = &modelShark;
+        sharkPacket.view = &view;
+        sharkPacket.projection = &projection;
+        sharkPacket.depth = glm::length(offset);
+        sharkModel.submit(renderQueue, sharkPacket);
 
         renderFishes(view,projection);
+        skybox.submit(renderQueue, skyboxProgram, skyboxView, projection);
+
+        renderQueue.execute();
     }
 
     void processInput() {
@@ -687,7 +1379,7 @@ unsigned int loadTexture(char const * path)
     return textureID;
 }
 
-unsigned int loadCubemap(vector<std::string> faces)
+unsigned int loadCubemap(const vector<std::string>& faces)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);